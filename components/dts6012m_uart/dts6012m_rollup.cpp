@@ -0,0 +1,336 @@
+/**
+ * @file dts6012m_rollup.cpp
+ * @brief Round-robin rollup store implementation for DTS6012M distance readings
+ * @version 1.1.0
+ * @date 2025
+ * @dlsnet
+ *
+ * @license MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "dts6012m_rollup.h"
+#include <algorithm>
+#include <cinttypes>
+
+namespace esphome {
+namespace dts6012m_uart {
+
+static const char *const TAG = "dts6012m_uart.rollup";
+
+// Period lengths in seconds
+constexpr uint32_t MINUTE_SECONDS = 60;
+constexpr uint32_t HOUR_SECONDS = 3600;
+constexpr uint32_t DAY_SECONDS = 86400;
+
+// Preference key offsets, one blob per level
+constexpr uint32_t MINUTE_PREF_SALT = 0x524D0001;
+constexpr uint32_t HOUR_PREF_SALT = 0x524D0002;
+constexpr uint32_t DAY_PREF_SALT = 0x524D0003;
+
+static void accumulator_reset(RollupAccumulator &acc, uint32_t period) {
+  acc.period = period;
+  acc.min_mm = UINT16_MAX;
+  acc.max_mm = 0;
+  acc.count = 0;
+  acc.sum_mm = 0;
+}
+
+static void accumulator_merge(RollupAccumulator &acc, const RollupAccumulator &other) {
+  if (other.min_mm < acc.min_mm)
+    acc.min_mm = other.min_mm;
+  if (other.max_mm > acc.max_mm)
+    acc.max_mm = other.max_mm;
+  acc.count += other.count;
+  acc.sum_mm += other.sum_mm;
+}
+
+static RollupBucket accumulator_to_bucket(const RollupAccumulator &acc) {
+  RollupBucket bucket{};
+  if (acc.count == 0)
+    return bucket;
+  bucket.min_mm = acc.min_mm;
+  bucket.max_mm = acc.max_mm;
+  bucket.mean_mm = static_cast<uint16_t>((acc.sum_mm + acc.count / 2) / acc.count);
+  bucket.count = acc.count;
+  return bucket;
+}
+
+template<size_t N> static void ring_push(RollupRing<N> &ring, uint32_t period, const RollupBucket &bucket) {
+  if (period > ring.head_period) {
+    // Clear slots of skipped periods so stale data never reappears
+    uint32_t gap = period - ring.head_period;
+    if (gap > N)
+      gap = N;
+    for (uint32_t i = 1; i < gap; i++) {
+      ring.buckets[(period - i) % N] = RollupBucket{};
+    }
+    ring.head_period = period;
+  } else if (ring.head_period - period >= N) {
+    ESP_LOGW(TAG, "Dropping rollup for period %" PRIu32 ", older than ring", period);
+    return;
+  }
+  ring.buckets[period % N] = bucket;
+}
+
+template<size_t N> static bool ring_get(const RollupRing<N> &ring, uint32_t period, RollupBucket *bucket) {
+  if (period > ring.head_period || ring.head_period - period >= N)
+    return false;
+  const RollupBucket &slot = ring.buckets[period % N];
+  if (slot.count == 0)
+    return false;
+  *bucket = slot;
+  return true;
+}
+
+template<size_t N> static void ring_close_open(RollupRing<N> &ring, RollupAccumulator *closed) {
+  *closed = ring.open;
+  ring.open.count = 0;
+  ring_push(ring, closed->period, accumulator_to_bucket(*closed));
+}
+
+void RollupStore::setup(uint32_t hash_base) {
+  minute_pref_ = global_preferences->make_preference<RollupRing<MINUTE_SLOTS>>(hash_base ^ MINUTE_PREF_SALT, true);
+  hour_pref_ = global_preferences->make_preference<RollupRing<HOUR_SLOTS>>(hash_base ^ HOUR_PREF_SALT, true);
+  day_pref_ = global_preferences->make_preference<RollupRing<DAY_SLOTS>>(hash_base ^ DAY_PREF_SALT, true);
+
+  if (!minute_pref_.load(&minutes_))
+    minutes_ = {};
+  if (!hour_pref_.load(&hours_))
+    hours_ = {};
+  if (!day_pref_.load(&days_))
+    days_ = {};
+
+  ESP_LOGD(TAG, "Rollups restored, heads: minute %" PRIu32 ", hour %" PRIu32 ", day %" PRIu32,
+           minutes_.head_period, hours_.head_period, days_.head_period);
+}
+
+void RollupStore::add(uint16_t distance_mm, uint32_t now_s) {
+  uint32_t minute = now_s / MINUTE_SECONDS;
+
+  if (minutes_.open.count > 0 && minutes_.open.period != minute) {
+    close_minute_();
+  }
+  if (minutes_.open.count == 0) {
+    accumulator_reset(minutes_.open, minute);
+  }
+
+  RollupAccumulator &acc = minutes_.open;
+  if (distance_mm < acc.min_mm)
+    acc.min_mm = distance_mm;
+  if (distance_mm > acc.max_mm)
+    acc.max_mm = distance_mm;
+  acc.count++;
+  acc.sum_mm += distance_mm;
+  dirty_ = true;
+}
+
+void RollupStore::close_minute_() {
+  RollupAccumulator closed;
+  ring_close_open(minutes_, &closed);
+
+  uint32_t hour = closed.period * MINUTE_SECONDS / HOUR_SECONDS;
+  if (hours_.open.count > 0 && hours_.open.period != hour) {
+    close_hour_();
+  }
+  if (hours_.open.count == 0) {
+    accumulator_reset(hours_.open, hour);
+  }
+  accumulator_merge(hours_.open, closed);
+}
+
+void RollupStore::close_hour_() {
+  RollupAccumulator closed;
+  ring_close_open(hours_, &closed);
+
+  uint32_t day = closed.period * HOUR_SECONDS / DAY_SECONDS;
+  if (days_.open.count > 0 && days_.open.period != day) {
+    close_day_();
+  }
+  if (days_.open.count == 0) {
+    accumulator_reset(days_.open, day);
+  }
+  accumulator_merge(days_.open, closed);
+
+  // Persist once per hour rather than per minute to limit flash wear,
+  // the owner performs the save outside the frame parser
+  save_pending_ = true;
+}
+
+void RollupStore::close_day_() {
+  RollupAccumulator closed;
+  ring_close_open(days_, &closed);
+  ESP_LOGD(TAG, "Day %" PRIu32 " closed: %" PRIu32 " samples", closed.period, closed.count);
+}
+
+void RollupStore::save() {
+  save_pending_ = false;
+  if (!dirty_)
+    return;
+  minute_pref_.save(&minutes_);
+  hour_pref_.save(&hours_);
+  day_pref_.save(&days_);
+  dirty_ = false;
+  ESP_LOGD(TAG, "Rollups saved");
+}
+
+bool RollupStore::get_open_(RollupLevel level, uint32_t period, RollupAccumulator *acc) const {
+  // A level's open accumulator only holds closed sub-periods, so fold in
+  // the open accumulators of every finer level that fall into this period
+  const RollupAccumulator *opens[ROLLUP_LEVEL_COUNT] = {&minutes_.open, &hours_.open, &days_.open};
+  uint32_t length = period_seconds(level);
+  accumulator_reset(*acc, period);
+  for (uint8_t finer = ROLLUP_MINUTE; finer <= level; finer++) {
+    const RollupAccumulator &open = *opens[finer];
+    if (open.count == 0)
+      continue;
+    uint64_t start = static_cast<uint64_t>(open.period) * period_seconds(static_cast<RollupLevel>(finer));
+    if (start / length == period)
+      accumulator_merge(*acc, open);
+  }
+  return acc->count > 0;
+}
+
+bool RollupStore::get_bucket(RollupLevel level, uint32_t period, RollupBucket *bucket) const {
+  RollupAccumulator open;
+  if (level < ROLLUP_LEVEL_COUNT && get_open_(level, period, &open)) {
+    *bucket = accumulator_to_bucket(open);
+    return true;
+  }
+  switch (level) {
+    case ROLLUP_MINUTE:
+      return ring_get(minutes_, period, bucket);
+    case ROLLUP_HOUR:
+      return ring_get(hours_, period, bucket);
+    case ROLLUP_DAY:
+      return ring_get(days_, period, bucket);
+    default:
+      return false;
+  }
+}
+
+uint32_t RollupStore::period_seconds(RollupLevel level) {
+  switch (level) {
+    case ROLLUP_MINUTE:
+      return MINUTE_SECONDS;
+    case ROLLUP_HOUR:
+      return HOUR_SECONDS;
+    case ROLLUP_DAY:
+      return DAY_SECONDS;
+    default:
+      return 0;
+  }
+}
+
+uint32_t RollupStore::head_period(RollupLevel level) const {
+  switch (level) {
+    case ROLLUP_MINUTE:
+      return minutes_.head_period;
+    case ROLLUP_HOUR:
+      return hours_.head_period;
+    case ROLLUP_DAY:
+      return days_.head_period;
+    default:
+      return 0;
+  }
+}
+
+size_t RollupStore::slot_count(RollupLevel level) {
+  switch (level) {
+    case ROLLUP_MINUTE:
+      return MINUTE_SLOTS;
+    case ROLLUP_HOUR:
+      return HOUR_SLOTS;
+    case ROLLUP_DAY:
+      return DAY_SLOTS;
+    default:
+      return 0;
+  }
+}
+
+uint32_t RollupStore::resume_seconds() const {
+  uint32_t minute = minutes_.head_period;
+  if (minutes_.open.count > 0 && minutes_.open.period > minute)
+    minute = minutes_.open.period;
+  return (minute + 1) * MINUTE_SECONDS;
+}
+
+bool RollupStore::parse_level(const std::string &name, RollupLevel *level) {
+  if (name == "minute") {
+    *level = ROLLUP_MINUTE;
+  } else if (name == "hour") {
+    *level = ROLLUP_HOUR;
+  } else if (name == "day") {
+    *level = ROLLUP_DAY;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+std::string RollupStore::format_range(RollupLevel level, uint32_t from_s, uint32_t to_s) const {
+  std::string out;
+  uint32_t length = period_seconds(level);
+  size_t slots = slot_count(level);
+  if (length == 0)
+    return out;
+
+  uint32_t head = head_period(level);
+  uint32_t oldest = head + 1 >= slots ? head + 1 - slots : 0;
+
+  // Open periods of this and finer levels usually sit just past the ring
+  // head, possibly several apart after a gap; collect them in order
+  const RollupAccumulator *opens[ROLLUP_LEVEL_COUNT] = {&minutes_.open, &hours_.open, &days_.open};
+  uint32_t pending[ROLLUP_LEVEL_COUNT];
+  size_t pending_count = 0;
+  for (uint8_t finer = ROLLUP_MINUTE; finer <= level; finer++) {
+    const RollupAccumulator &open = *opens[finer];
+    if (open.count == 0)
+      continue;
+    uint64_t start = static_cast<uint64_t>(open.period) * period_seconds(static_cast<RollupLevel>(finer));
+    uint32_t period = static_cast<uint32_t>(start / length);
+    if (period > head)
+      pending[pending_count++] = period;  // Periods up to head are visited with the ring
+  }
+  std::sort(pending, pending + pending_count);
+  pending_count = std::unique(pending, pending + pending_count) - pending;
+
+  char record[48];
+  auto emit = [&](uint32_t period) {
+    RollupBucket bucket;
+    uint32_t start = period * length;
+    if (get_bucket(level, period, &bucket) && start >= from_s && (to_s == 0 || start <= to_s)) {
+      snprintf(record, sizeof(record), "%" PRIu32 ",%u,%u,%u,%" PRIu32 ";", start, bucket.min_mm, bucket.max_mm,
+               bucket.mean_mm, bucket.count);
+      out += record;
+    }
+  };
+  for (uint32_t period = oldest; period <= head; period++)
+    emit(period);
+  for (size_t i = 0; i < pending_count; i++)
+    emit(pending[i]);
+
+  if (!out.empty())
+    out.pop_back();  // Drop trailing separator
+  return out;
+}
+
+}  // namespace dts6012m_uart
+}  // namespace esphome
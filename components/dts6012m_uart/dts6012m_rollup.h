@@ -0,0 +1,169 @@
+/**
+ * @file dts6012m_rollup.h
+ * @brief Round-robin minute/hour/day rollup store for DTS6012M distance readings
+ * @version 1.1.0
+ * @date 2025
+ * @dlsnet
+ *
+ * @license MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#pragma once
+
+#ifndef DTS6012M_ROLLUP_H
+#define DTS6012M_ROLLUP_H
+
+#include "esphome.h"
+#include <string>
+
+namespace esphome {
+namespace dts6012m_uart {
+
+/// @brief Rollup resolution levels, finest first
+enum RollupLevel : uint8_t {
+  ROLLUP_MINUTE = 0,
+  ROLLUP_HOUR = 1,
+  ROLLUP_DAY = 2,
+  ROLLUP_LEVEL_COUNT = 3,
+};
+
+/**
+ * @struct RollupBucket
+ * @brief One closed aggregate slot, packed integers in millimetres
+ */
+struct RollupBucket {
+  uint16_t min_mm;   ///< Smallest distance seen in the period
+  uint16_t max_mm;   ///< Largest distance seen in the period
+  uint16_t mean_mm;  ///< Rounded mean distance over the period
+  uint16_t reserved; ///< Keeps the layout explicit for persistence
+  uint32_t count;    ///< Number of frames aggregated, 0 marks an empty slot
+};
+
+/**
+ * @struct RollupAccumulator
+ * @brief Running aggregate for the period currently being filled
+ */
+struct RollupAccumulator {
+  uint32_t period;   ///< Period index (start seconds / period length)
+  uint16_t min_mm;
+  uint16_t max_mm;
+  uint32_t count;
+  uint64_t sum_mm;   ///< Exact sum, so cascaded means stay unbiased
+};
+
+/**
+ * @struct RollupRing
+ * @brief Fixed-size ring of closed buckets plus its open accumulator
+ *
+ * Slot `period % N` holds the bucket of `period` for any period in
+ * (head_period - N, head_period]. The whole struct is stored as a single
+ * preference blob, so its size must stay constant between firmware builds.
+ */
+template<size_t N> struct RollupRing {
+  uint32_t head_period;      ///< Newest period index written to the ring
+  RollupAccumulator open;    ///< Partially filled current period
+  RollupBucket buckets[N];   ///< Closed periods
+};
+
+/**
+ * @class RollupStore
+ * @brief Incremental RRD-style rollups computed from the per-frame stream
+ *
+ * Every valid frame updates the open minute accumulator only. Closing a
+ * minute folds it into the hour accumulator, closing an hour folds it into
+ * the day accumulator, so the per-frame cost is constant regardless of the
+ * number of levels. An hour rollover only requests a save via needs_save(),
+ * the owner writes the rings outside the frame hot path and on shutdown.
+ */
+class RollupStore {
+ public:
+  static constexpr size_t MINUTE_SLOTS = 60;  ///< One hour of minutes
+  static constexpr size_t HOUR_SLOTS = 48;    ///< Two days of hours
+  static constexpr size_t DAY_SLOTS = 31;     ///< One month of days
+
+  /// @brief Load persisted rings from preferences
+  /// @param hash_base Per-instance base for the preference keys
+  void setup(uint32_t hash_base);
+
+  /// @brief Add one distance sample
+  /// @param distance_mm Measured distance in millimetres
+  /// @param now_s Current time in seconds (epoch or persisted uptime)
+  void add(uint16_t distance_mm, uint32_t now_s);
+
+  /// @brief Write all rings to preferences
+  void save();
+
+  /// @brief An hour closed since the last save, so the rings should be saved
+  bool needs_save() const { return save_pending_; }
+
+  /// @brief Format buckets whose start lies in [from_s, to_s] as compact text
+  /// @param level Rollup resolution to read
+  /// @param from_s Earliest bucket start in seconds, 0 for no lower bound
+  /// @param to_s Latest bucket start in seconds, 0 for no upper bound
+  /// @return "start,min,max,mean,count" records separated by ';'
+  std::string format_range(RollupLevel level, uint32_t from_s, uint32_t to_s) const;
+
+  /// @brief Read one bucket by period index, including the open one; open
+  /// buckets include frames from the still open finer periods
+  /// @return true if the bucket is held and non-empty
+  bool get_bucket(RollupLevel level, uint32_t period, RollupBucket *bucket) const;
+
+  /// @brief Period length of a level in seconds
+  static uint32_t period_seconds(RollupLevel level);
+
+  /// @brief Newest period index of a level
+  uint32_t head_period(RollupLevel level) const;
+
+  /// @brief Number of slots of a level
+  static size_t slot_count(RollupLevel level);
+
+  /// @brief First uptime second after everything already stored
+  /// @return Clock origin for installs without a real time clock
+  uint32_t resume_seconds() const;
+
+  /// @brief Parse "minute", "hour" or "day"
+  /// @return true if the name is recognised
+  static bool parse_level(const std::string &name, RollupLevel *level);
+
+ protected:
+  /// @brief Fold a closed minute into the hour level, cascading to days
+  void close_minute_();
+  void close_hour_();
+  void close_day_();
+
+  /// @brief Merge the open accumulators of `level` and finer levels that fall into `period`
+  /// @return true if any frames were merged
+  bool get_open_(RollupLevel level, uint32_t period, RollupAccumulator *acc) const;
+
+  RollupRing<MINUTE_SLOTS> minutes_{};
+  RollupRing<HOUR_SLOTS> hours_{};
+  RollupRing<DAY_SLOTS> days_{};
+  ESPPreferenceObject minute_pref_;
+  ESPPreferenceObject hour_pref_;
+  ESPPreferenceObject day_pref_;
+  bool dirty_ = false;         ///< Unsaved changes since the last save
+  bool save_pending_ = false;  ///< An hour closed since the last save
+};
+
+}  // namespace dts6012m_uart
+}  // namespace esphome
+
+#endif  // DTS6012M_ROLLUP_H
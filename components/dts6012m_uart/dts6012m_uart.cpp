@@ -27,6 +27,8 @@
  */
 
 #include "dts6012m_uart.h"
+#include <cinttypes>
+#include <cmath>
 #include <cstring>
 
 namespace esphome {
@@ -47,13 +49,61 @@ constexpr uint32_t COMMUNICATION_TIMEOUT_MS = 10000;  // 10 seconds
 constexpr size_t MAX_BYTES_PER_LOOP = 32;             // Prevent loop blocking
 constexpr float DISTANCE_CHANGE_THRESHOLD = 0.01f;    // 10mm change threshold
 
+// Time-to-collision constants
+constexpr uint32_t TTC_STALE_US = 500000;             // Gap that restarts the estimator
+constexpr uint32_t TTC_FRAME_TIMEOUT_MS = 500;        // No frames for this long asserts stop
+constexpr uint32_t TTC_WARMUP_TIME_CONSTANTS = 2;     // EMA time constants before stop may release
+constexpr int32_t TTC_MIN_CLOSING_MM_S = 10;          // Slower approach counts as not closing
+constexpr int32_t TTC_MAX_VELOCITY_MM_S = 10000;      // Physical limit, larger deltas are noise
+constexpr uint32_t UART_BITS_PER_BYTE = 10;           // Start + 8 data + stop bit
+constexpr uint32_t TTC_HYSTERESIS_NUM = 5;            // Release/re-arm above 5/4 of a threshold
+constexpr uint32_t TTC_HYSTERESIS_DEN = 4;
+constexpr uint32_t TTC_PUBLISH_THRESHOLD_MS = 100;    // 100ms change threshold for the TTC sensor
+
+// One rounded EMA step, so the average settles on the input instead of
+// stalling up to 2^shift - 1 units below a rising value
+static int32_t ema_step(int32_t average, int32_t sample, uint8_t shift) {
+  if (shift == 0) {
+    return sample;
+  }
+  return average + ((sample - average + (1 << (shift - 1))) >> shift);
+}
+
+// True once an estimate has cleared a threshold by the hysteresis margin
+static bool ttc_above_hysteresis(uint32_t ttc_ms, uint32_t threshold_ms) {
+  return static_cast<uint64_t>(ttc_ms) * TTC_HYSTERESIS_DEN > static_cast<uint64_t>(threshold_ms) * TTC_HYSTERESIS_NUM;
+}
+
 void DTS6012MUartSensor::setup() {
   ESP_LOGCONFIG(TAG, "Setting up DTS6012M UART Sensor");
   reset_sensor();
+  
+  if (rollups_) {
+    rollups_->setup(this->get_object_id_hash());
+    rollup_base_s_ = rollups_->resume_seconds();
+    rollup_last_ms_ = millis();
+  }
+  
+  if (ttc_enabled_) {
+    // Frames cannot arrive closer together than their own transmission time
+    uint32_t baud_rate = this->parent_->get_baud_rate();
+    ttc_us_per_byte_ = baud_rate > 0 ? UART_BITS_PER_BYTE * 1000000UL / baud_rate : 0;
+  }
+  
+  if (stop_pin_ != nullptr) {
+    stop_pin_->setup();
+    stop_pin_->digital_write(false);
+  }
+  
+  if (publish_interval_ > 0) {
+    this->set_interval("publish", publish_interval_, [this]() { this->publish_window_(); });
+  }
+  
   delay(1000);  // Allow sensor to stabilize
   send_start_command_();
   measurement_started_ = true;
   last_communication_time_ = millis();
+  ttc_last_frame_ms_ = last_communication_time_;
 }
 
 void DTS6012MUartSensor::update() {
@@ -156,6 +206,12 @@ void DTS6012MUartSensor::loop() {
   if (data_received) {
     last_communication_time_ = millis();
   }
+  
+  // Fail safe: hold or assert stop when distance frames stop arriving
+  if (stop_pin_ != nullptr && !stop_active_ && millis() - ttc_last_frame_ms_ > TTC_FRAME_TIMEOUT_MS) {
+    ESP_LOGW(TAG, "No frames for %" PRIu32 " ms, asserting stop", TTC_FRAME_TIMEOUT_MS);
+    set_stop_(true);
+  }
 }
 
 void DTS6012MUartSensor::send_start_command_() {
@@ -186,11 +242,23 @@ void DTS6012MUartSensor::send_start_command_() {
   }
 }
 
+void DTS6012MUartSensor::on_shutdown() {
+  if (rollups_) {
+    rollups_->save();
+  }
+}
+
 void DTS6012MUartSensor::reset_sensor() {
   buffer_index_ = 0;
   last_distance_ = -1;
+  window_sum_mm_ = 0;
+  window_count_ = 0;
+  window_no_target_ = false;
   measurement_started_ = false;
   last_communication_time_ = 0;
+  if (ttc_enabled_) {
+    reset_ttc_();
+  }
   
   // Clear any pending UART data
   while (this->available()) {
@@ -217,6 +285,183 @@ uint16_t DTS6012MUartSensor::calculate_crc16_(const uint8_t *data, size_t length
   return crc;
 }
 
+void DTS6012MUartSensor::record_rollup_(uint16_t distance_mm) {
+  uint32_t now_ms = millis();
+  rollup_elapsed_ms_ += now_ms - rollup_last_ms_;
+  rollup_last_ms_ = now_ms;
+  
+#ifdef USE_TIME
+  if (time_ != nullptr) {
+    // Wait for a valid clock so buckets never mix uptime and epoch periods
+    ESPTime now = time_->now();
+    if (!now.is_valid()) {
+      return;
+    }
+    rollups_->add(distance_mm, static_cast<uint32_t>(now.timestamp));
+    schedule_rollup_save_();
+    return;
+  }
+#endif
+  
+  rollups_->add(distance_mm, rollup_base_s_ + static_cast<uint32_t>(rollup_elapsed_ms_ / 1000));
+  schedule_rollup_save_();
+}
+
+void DTS6012MUartSensor::schedule_rollup_save_() {
+  if (!rollups_->needs_save()) {
+    return;
+  }
+  // Flash writes take milliseconds, keep them out of the frame parser
+  this->defer("rollup_save", [this]() { rollups_->save(); });
+}
+
+void DTS6012MUartSensor::update_ttc_(uint16_t distance_mm, size_t frame_len) {
+  uint32_t now_us = micros();
+  int32_t sample_q4 = static_cast<int32_t>(distance_mm) << 4;
+  
+  if (!ttc_primed_ || now_us - ttc_last_us_ > TTC_STALE_US) {
+    // First frame or a long gap: restart from this sample without a velocity
+    ttc_distance_q4_ = sample_q4;
+    ttc_velocity_q4_ = 0;
+    ttc_last_us_ = now_us;
+    ttc_primed_ = true;
+    ttc_frames_ = 0;
+    ttc_ms_ = UINT32_MAX;
+    apply_ttc_();
+    return;
+  }
+  
+  // Frames parsed back to back from a backlog are stamped microseconds apart,
+  // clamp to the frame transmission time so velocity is not inflated
+  uint32_t dt_us = now_us - ttc_last_us_;
+  uint32_t min_dt_us = frame_len * ttc_us_per_byte_;
+  if (min_dt_us == 0) {
+    min_dt_us = 1;
+  }
+  if (dt_us < min_dt_us) {
+    dt_us = min_dt_us;
+  }
+  ttc_last_us_ = now_us;
+  if (ttc_frames_ < UINT16_MAX) {
+    ttc_frames_++;
+  }
+  
+  // Exponential moving averages in integer arithmetic
+  int32_t previous_q4 = ttc_distance_q4_;
+  ttc_distance_q4_ = ema_step(ttc_distance_q4_, sample_q4, ttc_smoothing_shift_);
+  
+  // Closing velocity in mm/s Q4: Q4 delta * 1e6 / dt_us
+  int64_t raw_velocity_q4 = static_cast<int64_t>(previous_q4 - ttc_distance_q4_) * 1000000 / dt_us;
+  if (raw_velocity_q4 > TTC_MAX_VELOCITY_MM_S * 16) {
+    raw_velocity_q4 = TTC_MAX_VELOCITY_MM_S * 16;
+  } else if (raw_velocity_q4 < -TTC_MAX_VELOCITY_MM_S * 16) {
+    raw_velocity_q4 = -TTC_MAX_VELOCITY_MM_S * 16;
+  }
+  ttc_velocity_q4_ = ema_step(ttc_velocity_q4_, static_cast<int32_t>(raw_velocity_q4), ttc_smoothing_shift_);
+  
+  if (ttc_velocity_q4_ < TTC_MIN_CLOSING_MM_S * 16) {
+    ttc_ms_ = UINT32_MAX;
+  } else {
+    // Both operands are Q4, so the scale cancels
+    int64_t ttc = static_cast<int64_t>(ttc_distance_q4_) * 1000 / ttc_velocity_q4_;
+    ttc_ms_ = ttc >= UINT32_MAX ? UINT32_MAX - 1 : static_cast<uint32_t>(ttc);
+  }
+  
+  apply_ttc_();
+}
+
+void DTS6012MUartSensor::apply_ttc_() {
+  // Stop path first, so it never waits on automations or publishing.
+  // Stop is latched: here only a settled estimate that clears the hysteresis
+  // releases it, never an estimator restart. Target loss releases it only
+  // through release_after_no_target, see parse_data_frame_().
+  if (stop_pin_ != nullptr) {
+    bool settled = ttc_primed_ && ttc_frames_ >= (TTC_WARMUP_TIME_CONSTANTS << ttc_smoothing_shift_);
+    if (!stop_active_ && ttc_ms_ < stop_below_ms_) {
+      ESP_LOGW(TAG, "Stop asserted, time to collision %" PRIu32 " ms", ttc_ms_);
+      set_stop_(true);
+    } else if (stop_active_ && settled && ttc_above_hysteresis(ttc_ms_, stop_below_ms_)) {
+      ESP_LOGI(TAG, "Stop released");
+      set_stop_(false);
+    }
+  }
+  
+  for (auto *trigger : ttc_triggers_) {
+    trigger->process(ttc_ms_);
+  }
+  
+  if (ttc_sensor_ != nullptr) {
+    if (publish_interval_ > 0) {
+      // Lean mode: keep the most urgent estimate for the aggregated publish
+      if (!ttc_window_updated_ || ttc_ms_ < ttc_window_min_ms_) {
+        ttc_window_min_ms_ = ttc_ms_;
+      }
+      ttc_window_updated_ = true;
+    } else {
+      publish_ttc_(ttc_ms_);
+    }
+  }
+}
+
+void DTS6012MUartSensor::publish_ttc_(uint32_t ttc_ms) {
+  bool valid = ttc_ms != UINT32_MAX;
+  uint32_t delta = ttc_ms > ttc_published_ms_ ? ttc_ms - ttc_published_ms_ : ttc_published_ms_ - ttc_ms;
+  if (valid != ttc_published_valid_ || (valid && delta >= TTC_PUBLISH_THRESHOLD_MS)) {
+    ttc_sensor_->publish_state(valid ? ttc_ms / 1000.0f : NAN);
+    ttc_published_ms_ = ttc_ms;
+    ttc_published_valid_ = valid;
+  }
+}
+
+void DTS6012MUartSensor::release_stop() {
+  if (stop_pin_ == nullptr || !stop_active_) {
+    return;
+  }
+  ESP_LOGI(TAG, "Stop released on request");
+  set_stop_(false);
+}
+
+void DTS6012MUartSensor::set_stop_(bool active) {
+  stop_pin_->digital_write(active);
+  stop_active_ = active;
+  no_target_frames_ = 0;
+}
+
+void DTS6012MUartSensor::reset_ttc_() {
+  ttc_primed_ = false;
+  ttc_frames_ = 0;
+  ttc_velocity_q4_ = 0;
+  ttc_ms_ = UINT32_MAX;
+  for (auto *trigger : ttc_triggers_) {
+    trigger->reset();
+  }
+  apply_ttc_();
+}
+
+void TTCBelowTrigger::process(uint32_t ttc_ms) {
+  if (!active_ && ttc_ms < below_ms_) {
+    active_ = true;
+    this->trigger(ttc_ms / 1000.0f);
+  } else if (active_ && ttc_above_hysteresis(ttc_ms, below_ms_)) {
+    active_ = false;
+  }
+}
+
+std::string DTS6012MUartSensor::query_rollups(const std::string &level, uint32_t from_s, uint32_t to_s) {
+  if (!rollups_) {
+    ESP_LOGW(TAG, "Rollup query ignored, rollups are not enabled");
+    return "";
+  }
+  
+  RollupLevel parsed;
+  if (!RollupStore::parse_level(level, &parsed)) {
+    ESP_LOGW(TAG, "Unknown rollup level '%s'", level.c_str());
+    return "";
+  }
+  
+  return rollups_->format_range(parsed, from_s, to_s);
+}
+
 bool DTS6012MUartSensor::parse_data_frame_(const uint8_t *data, size_t len) {
   // Validate minimum frame length
   if (len < 9) {
@@ -246,26 +491,102 @@ bool DTS6012MUartSensor::parse_data_frame_(const uint8_t *data, size_t len) {
   uint16_t distance_mm = (data[DISTANCE_DATA_POS + 1] << 8) | data[DISTANCE_DATA_POS];
   float distance_m = distance_mm / 1000.0f;
   
+  // Any distance frame, with or without target, proves the sensor is alive
+  ttc_last_frame_ms_ = millis();
+  
   // Handle no target detected case (0xFFFF)
   if (distance_mm == 0xFFFF) {
-    if (last_distance_ != NAN) {
-      ESP_LOGI(TAG, "No valid target detected");
-      this->publish_state(NAN);
-      last_distance_ = NAN;
+    if (ttc_enabled_ && ttc_primed_) {
+      reset_ttc_();
+    }
+    if (stop_active_ && stop_release_no_target_frames_ > 0) {
+      // Frames are arriving again but nothing is in range: after a long
+      // enough run, treat the path as clear instead of holding stop forever
+      if (++no_target_frames_ >= stop_release_no_target_frames_) {
+        ESP_LOGI(TAG, "Stop released after %u frames without target", no_target_frames_);
+        set_stop_(false);
+      }
+    }
+    raw_distance_callback_.call(NAN);
+    if (publish_interval_ > 0) {
+      // Published at the aggregated rate, frames before the loss are stale
+      window_sum_mm_ = 0;
+      window_count_ = 0;
+      window_no_target_ = true;
+    } else {
+      publish_no_target_();
     }
     return true;
   }
   
+  no_target_frames_ = 0;
+  
+  // Collision estimate runs ahead of logging and publishing to bound latency
+  if (ttc_enabled_) {
+    update_ttc_(distance_mm, len);
+  }
+  
+  // Rollups see every frame, independent of the publish threshold
+  if (rollups_) {
+    record_rollup_(distance_mm);
+  }
+  
+  // Lightweight per-frame path for internal consumers
+  raw_distance_callback_.call(distance_m);
+  
+  if (publish_interval_ > 0) {
+    // Lean mode: aggregate here, full sensor publish runs from the interval
+    window_sum_mm_ += distance_mm;
+    window_count_++;
+    window_no_target_ = false;
+    return true;
+  }
+  
+  publish_distance_(distance_mm);
+  return true;
+}
+
+void DTS6012MUartSensor::publish_distance_(uint16_t distance_mm) {
+  float distance_m = distance_mm / 1000.0f;
+  
   // Check if this is a significant change from last reading
-  if (last_distance_ < 0 || fabs(distance_m - last_distance_) >= DISTANCE_CHANGE_THRESHOLD) {
+  if (last_distance_ < 0 || std::isnan(last_distance_) ||
+      fabs(distance_m - last_distance_) >= DISTANCE_CHANGE_THRESHOLD) {
     ESP_LOGI(TAG, "Distance: %d mm (%.3f m)", distance_mm, distance_m);
     this->publish_state(distance_m);
     last_distance_ = distance_m;
   } else {
     ESP_LOGD(TAG, "Distance: %d mm (%.3f m) - no significant change", distance_mm, distance_m);
   }
+}
+
+void DTS6012MUartSensor::publish_no_target_() {
+  if (!std::isnan(last_distance_)) {
+    ESP_LOGI(TAG, "No valid target detected");
+    this->publish_state(NAN);
+    last_distance_ = NAN;
+  }
+}
+
+void DTS6012MUartSensor::publish_window_() {
+  if (window_no_target_) {
+    // Target lost by the end of the window, earlier frames are stale
+    publish_no_target_();
+  } else if (window_count_ > 0) {
+    // Rounded mean of the frames received since the last publish
+    uint16_t mean_mm = static_cast<uint16_t>((window_sum_mm_ + window_count_ / 2) / window_count_);
+    ESP_LOGD(TAG, "Publishing mean of %" PRIu32 " frames", window_count_);
+    publish_distance_(mean_mm);
+  }
   
-  return true;
+  if (ttc_sensor_ != nullptr && ttc_window_updated_) {
+    publish_ttc_(ttc_window_min_ms_);
+    ttc_window_updated_ = false;
+  }
+  
+  window_sum_mm_ = 0;
+  window_count_ = 0;
+  window_no_target_ = false;
 }
 
 void DTS6012MUartSensor::dump_config() {
@@ -275,6 +596,30 @@ void DTS6012MUartSensor::dump_config() {
   ESP_LOGCONFIG(TAG, "  Measurement started: %s", measurement_started_ ? "Yes" : "No");
   ESP_LOGCONFIG(TAG, "  Communication timeout: %d ms", COMMUNICATION_TIMEOUT_MS);
   ESP_LOGCONFIG(TAG, "  Distance threshold: %.3f m", DISTANCE_CHANGE_THRESHOLD);
+  if (publish_interval_ > 0) {
+    ESP_LOGCONFIG(TAG, "  Lean publish interval: %" PRIu32 " ms", publish_interval_);
+  }
+  if (rollups_) {
+    ESP_LOGCONFIG(TAG, "  Rollups: %d minutes, %d hours, %d days", RollupStore::MINUTE_SLOTS,
+                  RollupStore::HOUR_SLOTS, RollupStore::DAY_SLOTS);
+#ifdef USE_TIME
+    ESP_LOGCONFIG(TAG, "  Rollup clock: %s", time_ != nullptr ? "Real time" : "Uptime");
+#endif
+  }
+  if (ttc_enabled_) {
+    ESP_LOGCONFIG(TAG, "  Time to collision smoothing: 1/%d", 1 << ttc_smoothing_shift_);
+    LOG_SENSOR("  ", "Time To Collision", ttc_sensor_);
+    if (stop_pin_ != nullptr) {
+      LOG_PIN("  Stop Pin: ", stop_pin_);
+      ESP_LOGCONFIG(TAG, "  Stop below: %" PRIu32 " ms", stop_below_ms_);
+      if (stop_release_no_target_frames_ > 0) {
+        ESP_LOGCONFIG(TAG, "  Stop release after: %u frames without target", stop_release_no_target_frames_);
+      }
+    }
+    for (auto *trigger : ttc_triggers_) {
+      ESP_LOGCONFIG(TAG, "  Trigger below: %" PRIu32 " ms", trigger->get_below_ms());
+    }
+  }
 }
 
 }  // namespace dts6012m_uart
@@ -33,10 +33,20 @@
 
 #include "esphome.h"
 #include "esphome/components/uart/uart.h"
+#include "dts6012m_rollup.h"
+#include <memory>
+#include <string>
+#include <vector>
+
+#ifdef USE_TIME
+#include "esphome/components/time/real_time_clock.h"
+#endif
 
 namespace esphome {
 namespace dts6012m_uart {
 
+class TTCBelowTrigger;
+
 /**
  * @class DTS6012MUartSensor
  * @brief ESPHome component for DTS6012M UART distance sensor
@@ -50,6 +60,9 @@ namespace dts6012m_uart {
  * - CRC validation for data integrity
  * - Change-based publishing to reduce unnecessary updates
  * - Robust buffer management and error recovery
+ * - Optional on-device minute/hour/day rollups persisted across reboots
+ * - Optional per-frame time-to-collision with triggers and a direct stop pin
+ * - Lean publish mode: per-frame raw callbacks, aggregated sensor publishing
  */
 class DTS6012MUartSensor : public PollingComponent, public sensor::Sensor, public uart::UARTDevice {
  public:
@@ -65,8 +78,71 @@ class DTS6012MUartSensor : public PollingComponent, public sensor::Sensor, publi
   /// @brief Dump component configuration for debugging
   void dump_config() override;
   
+  /// @brief Persist rollups before reboot
+  void on_shutdown() override;
+  
   /// @brief Reset sensor state and clear buffers
   void reset_sensor();
+  
+  /// @brief Enable the on-device rollup store
+  void enable_rollups() { rollups_.reset(new RollupStore()); }
+  
+#ifdef USE_TIME
+  /// @brief Use a real time clock so rollup buckets align to wall-clock periods
+  void set_time(time::RealTimeClock *time) { time_ = time; }
+#endif
+  
+  /// @brief Query stored rollups
+  /// @param level "minute", "hour" or "day"
+  /// @param from_s Earliest bucket start in seconds, 0 for no lower bound
+  /// @param to_s Latest bucket start in seconds, 0 for no upper bound
+  /// @return "start,min,max,mean,count" records separated by ';', empty if none
+  std::string query_rollups(const std::string &level, uint32_t from_s, uint32_t to_s);
+  
+  /// @brief Enable time-to-collision estimation
+  /// @param smoothing_shift EMA weight of new samples is 1 / 2^shift
+  void enable_ttc(uint8_t smoothing_shift) {
+    ttc_enabled_ = true;
+    ttc_smoothing_shift_ = smoothing_shift;
+  }
+  
+  /// @brief Publish time-to-collision in seconds to this sensor
+  void set_ttc_sensor(sensor::Sensor *ttc_sensor) { ttc_sensor_ = ttc_sensor; }
+  
+  /// @brief Drive this pin high when time-to-collision drops below stop_below_ms
+  /// or frames stop arriving; it stays high until a settled estimate clears it
+  void set_stop_pin(GPIOPin *stop_pin, uint32_t stop_below_ms) {
+    stop_pin_ = stop_pin;
+    stop_below_ms_ = stop_below_ms;
+  }
+  
+  /// @brief Release a latched stop after this many consecutive no-target frames
+  /// @param frames Frame count, 0 keeps stop latched until a settled estimate clears it
+  void set_stop_release_no_target_frames(uint16_t frames) { stop_release_no_target_frames_ = frames; }
+  
+  /// @brief Release the stop pin now; it re-asserts on the next low TTC or frame timeout
+  void release_stop();
+  
+  /// @brief Register a time-to-collision threshold trigger
+  void add_ttc_trigger(TTCBelowTrigger *trigger) { ttc_triggers_.push_back(trigger); }
+  
+  /// @brief Latest time-to-collision estimate
+  /// @return Milliseconds, or UINT32_MAX when the target is not closing in
+  uint32_t get_ttc_ms() const { return ttc_ms_; }
+  
+  /// @brief Latest filtered closing velocity
+  /// @return Millimetres per second, positive when approaching
+  int32_t get_closing_velocity_mm_s() const { return ttc_velocity_q4_ / 16; }
+  
+  /// @brief Enable lean mode: publish the mean distance and the lowest TTC once per interval
+  /// @param publish_interval_ms Aggregation window, 0 publishes per frame
+  void set_publish_interval(uint32_t publish_interval_ms) { publish_interval_ = publish_interval_ms; }
+  
+  /// @brief Receive every frame's distance without the sensor publish pipeline
+  /// @param callback Called with meters, NAN when no target is detected
+  void add_on_raw_distance_callback(std::function<void(float)> &&callback) {
+    raw_distance_callback_.add(std::move(callback));
+  }
 
  private:
   /// @brief Send start measurement command to sensor
@@ -84,12 +160,138 @@ class DTS6012MUartSensor : public PollingComponent, public sensor::Sensor, publi
   /// @return Calculated CRC16 value
   uint16_t calculate_crc16_(const uint8_t *data, size_t length);
   
+  /// @brief Feed one valid distance into the rollup store
+  /// @param distance_mm Measured distance in millimetres
+  void record_rollup_(uint16_t distance_mm);
+  
+  /// @brief Defer a requested rollup save to the next main loop pass
+  void schedule_rollup_save_();
+  
+  /// @brief Update the time-to-collision estimate from one valid frame
+  /// @param distance_mm Measured distance in millimetres
+  /// @param frame_len Frame length in bytes, bounds the time since the previous frame
+  void update_ttc_(uint16_t distance_mm, size_t frame_len);
+  
+  /// @brief Drop estimator history and re-arm triggers, the stop pin stays latched
+  void reset_ttc_();
+  
+  /// @brief Drive the stop pin and remember its state
+  void set_stop_(bool active);
+  
+  /// @brief Apply a new estimate to the stop pin, triggers and TTC sensor
+  void apply_ttc_();
+  
+  /// @brief Publish a TTC estimate through the 100ms change threshold
+  /// @param ttc_ms Estimate in milliseconds, UINT32_MAX publishes NAN
+  void publish_ttc_(uint32_t ttc_ms);
+  
+  /// @brief Publish a distance through the change threshold
+  /// @param distance_mm Distance in millimetres
+  void publish_distance_(uint16_t distance_mm);
+  
+  /// @brief Publish NAN once when the target is lost
+  void publish_no_target_();
+  
+  /// @brief Publish the aggregated window in lean mode and start a new one
+  void publish_window_();
+  
   // Member variables
   uint8_t buffer_[64];           ///< Circular buffer for incoming UART data
   size_t buffer_index_ = 0;      ///< Current buffer write position
   bool measurement_started_ = false;  ///< Track if measurement has been initiated
   uint32_t last_communication_time_ = 0;  ///< Timestamp of last communication (send/receive)
   float last_distance_ = -1;     ///< Last published distance value for change detection
+  
+  // Rollup state
+  std::unique_ptr<RollupStore> rollups_;  ///< Rollup store, null when disabled
+  uint32_t rollup_base_s_ = 0;            ///< Uptime clock origin restored from the stored rings
+  uint64_t rollup_elapsed_ms_ = 0;        ///< Wrap-safe uptime since setup
+  uint32_t rollup_last_ms_ = 0;           ///< millis() at the previous rollup sample
+#ifdef USE_TIME
+  time::RealTimeClock *time_ = nullptr;   ///< Optional wall-clock source
+#endif
+  
+  // Time-to-collision state, fixed point
+  bool ttc_enabled_ = false;              ///< Estimation runs on every valid frame
+  bool ttc_primed_ = false;               ///< Estimator holds a previous sample
+  uint8_t ttc_smoothing_shift_ = 2;       ///< EMA shift for distance and velocity
+  int32_t ttc_distance_q4_ = 0;           ///< Filtered distance, mm in Q4
+  int32_t ttc_velocity_q4_ = 0;           ///< Filtered closing velocity, mm/s in Q4
+  uint32_t ttc_last_us_ = 0;              ///< micros() of the previous frame
+  uint32_t ttc_us_per_byte_ = 0;          ///< UART byte time, sets the minimum frame spacing
+  uint16_t ttc_frames_ = 0;               ///< Frames differentiated since the last restart
+  uint32_t ttc_last_frame_ms_ = 0;        ///< millis() of the last distance frame, for the stop timeout
+  uint32_t ttc_ms_ = UINT32_MAX;          ///< Latest estimate, UINT32_MAX when not closing
+  uint32_t ttc_published_ms_ = 0;         ///< Last value sent to ttc_sensor_
+  bool ttc_published_valid_ = false;      ///< ttc_sensor_ currently holds a finite value
+  sensor::Sensor *ttc_sensor_ = nullptr;  ///< Optional TTC output in seconds
+  GPIOPin *stop_pin_ = nullptr;           ///< Optional direct stop output
+  uint32_t stop_below_ms_ = 0;            ///< Stop pin assert threshold
+  bool stop_active_ = false;              ///< Stop pin currently asserted
+  uint16_t stop_release_no_target_frames_ = 0;  ///< No-target run that releases stop, 0 disables
+  uint16_t no_target_frames_ = 0;         ///< Consecutive no-target frames while stop is asserted
+  std::vector<TTCBelowTrigger *> ttc_triggers_;
+  
+  // Lean publish state
+  uint32_t publish_interval_ = 0;         ///< Aggregation window in ms, 0 when disabled
+  uint64_t window_sum_mm_ = 0;            ///< Sum of distances in the current window
+  uint32_t window_count_ = 0;             ///< Frames in the current window
+  bool window_no_target_ = false;         ///< Latest frame in the current window had no target
+  uint32_t ttc_window_min_ms_ = UINT32_MAX;  ///< Lowest TTC estimate in the current window
+  bool ttc_window_updated_ = false;       ///< TTC was estimated during the current window
+  CallbackManager<void(float)> raw_distance_callback_;  ///< Per-frame internal consumers
+};
+
+/**
+ * @class RawDistanceTrigger
+ * @brief Fires on every frame with the unfiltered distance in meters
+ */
+class RawDistanceTrigger : public Trigger<float> {
+ public:
+  explicit RawDistanceTrigger(DTS6012MUartSensor *parent) {
+    parent->add_on_raw_distance_callback([this](float distance) { this->trigger(distance); });
+  }
+};
+
+/**
+ * @class TTCBelowTrigger
+ * @brief Fires once when time-to-collision drops below a threshold
+ *
+ * Re-arms when the estimate rises above the threshold plus hysteresis or
+ * the target stops closing in. The argument is the estimate in seconds.
+ */
+class TTCBelowTrigger : public Trigger<float> {
+ public:
+  TTCBelowTrigger(DTS6012MUartSensor *parent, uint32_t below_ms) : below_ms_(below_ms) {
+    parent->add_ttc_trigger(this);
+  }
+  
+  /// @brief Evaluate a new estimate, firing on a downward crossing
+  /// @param ttc_ms Estimate in milliseconds, UINT32_MAX when not closing
+  void process(uint32_t ttc_ms);
+  
+  /// @brief Re-arm without firing
+  void reset() { active_ = false; }
+  
+  uint32_t get_below_ms() const { return below_ms_; }
+
+ protected:
+  uint32_t below_ms_;    ///< Firing threshold
+  bool active_ = false;  ///< Below threshold, waiting to re-arm
+};
+
+/**
+ * @class ReleaseStopAction
+ * @brief Action releasing a latched stop pin
+ */
+template<typename... Ts> class ReleaseStopAction : public Action<Ts...> {
+ public:
+  explicit ReleaseStopAction(DTS6012MUartSensor *parent) : parent_(parent) {}
+  
+  void play(Ts... x) override { this->parent_->release_stop(); }
+
+ protected:
+  DTS6012MUartSensor *parent_;
 };
 
 }  // namespace dts6012m_uart
@@ -48,19 +48,54 @@ THE SOFTWARE.
 
 import esphome.codegen as cg
 import esphome.config_validation as cv
-from esphome.components import sensor, uart
+from esphome import automation, pins
+from esphome.automation import Trigger
+from esphome.components import sensor, time, uart
 from esphome.const import (
+    CONF_BELOW,
     CONF_ID,
+    CONF_SENSOR,
+    CONF_TIME_ID,
+    CONF_TRIGGER_ID,
     DEVICE_CLASS_DISTANCE,
+    DEVICE_CLASS_DURATION,
     STATE_CLASS_MEASUREMENT,
     UNIT_METER,
+    UNIT_SECOND,
     ICON_ARROW_EXPAND_VERTICAL,
+    ICON_TIMER,
 )
+from esphome.core import CORE
 
 # Component dependencies and auto-loading
 DEPENDENCIES = ["uart"]
 AUTO_LOAD = ["uart"]
 
+# Configuration keys
+CONF_ROLLUPS = "rollups"
+CONF_TIME_TO_COLLISION = "time_to_collision"
+CONF_SMOOTHING = "smoothing"
+CONF_STOP_PIN = "stop_pin"
+CONF_STOP_BELOW = "stop_below"
+CONF_RELEASE_AFTER_NO_TARGET = "release_after_no_target"
+CONF_ON_BELOW = "on_below"
+CONF_PUBLISH_INTERVAL = "publish_interval"
+CONF_ON_RAW_VALUE = "on_raw_value"
+
+# Bytes of the three persisted rollup rings (minute 752, hour 608, day 408)
+ROLLUP_PREFERENCE_BYTES = 1768
+
+
+def validate_rollups_platform(config):
+    """Reject rollups where in-flash preference storage cannot hold the rings."""
+    if CORE.is_esp8266:
+        raise cv.Invalid(
+            f"rollups need {ROLLUP_PREFERENCE_BYTES} bytes of preference storage, "
+            "ESP8266 in-flash preferences only provide 512 bytes"
+        )
+    return config
+
+
 # Namespace declaration
 dts6012m_uart_ns = cg.esphome_ns.namespace("dts6012m_uart")
 DTS6012MUartSensor = dts6012m_uart_ns.class_(
@@ -69,6 +104,35 @@ DTS6012MUartSensor = dts6012m_uart_ns.class_(
     cg.PollingComponent, 
     uart.UARTDevice
 )
+ReleaseStopAction = dts6012m_uart_ns.class_("ReleaseStopAction", automation.Action)
+TTCBelowTrigger = dts6012m_uart_ns.class_("TTCBelowTrigger", Trigger.template(cg.float_))
+RawDistanceTrigger = dts6012m_uart_ns.class_("RawDistanceTrigger", Trigger.template(cg.float_))
+
+TIME_TO_COLLISION_SCHEMA = cv.Schema(
+    {
+        # Published in seconds, NAN while the target is not closing in
+        cv.Optional(CONF_SENSOR): sensor.sensor_schema(
+            unit_of_measurement=UNIT_SECOND,
+            icon=ICON_TIMER,
+            accuracy_decimals=2,
+            device_class=DEVICE_CLASS_DURATION,
+            state_class=STATE_CLASS_MEASUREMENT,
+        ),
+        # EMA weight of new frames is 1 / 2^smoothing
+        cv.Optional(CONF_SMOOTHING, default=2): cv.int_range(min=0, max=6),
+        # Driven high directly from the frame parser, no automation involved
+        cv.Optional(CONF_STOP_PIN): pins.gpio_output_pin_schema,
+        cv.Optional(CONF_STOP_BELOW, default="500ms"): cv.positive_time_period_milliseconds,
+        # Consecutive no-target frames that release a latched stop, 0 disables
+        cv.Optional(CONF_RELEASE_AFTER_NO_TARGET, default=0): cv.int_range(min=0, max=65535),
+        cv.Optional(CONF_ON_BELOW): automation.validate_automation(
+            {
+                cv.GenerateID(CONF_TRIGGER_ID): cv.declare_id(TTCBelowTrigger),
+                cv.Required(CONF_BELOW): cv.positive_time_period_milliseconds,
+            }
+        ),
+    }
+)
 
 CONFIG_SCHEMA = (
     sensor.sensor_schema(
@@ -79,6 +143,29 @@ CONFIG_SCHEMA = (
         device_class=DEVICE_CLASS_DISTANCE,
         state_class=STATE_CLASS_MEASUREMENT,
     )
+    .extend(
+        {
+            # On-device minute/hour/day rollups, persisted in flash
+            cv.Optional(CONF_ROLLUPS): cv.All(
+                cv.Schema(
+                    {
+                        cv.Optional(CONF_TIME_ID): cv.use_id(time.RealTimeClock),
+                    }
+                ),
+                validate_rollups_platform,
+            ),
+            # Per-frame time-to-collision for mobile installs
+            cv.Optional(CONF_TIME_TO_COLLISION): TIME_TO_COLLISION_SCHEMA,
+            # Lean mode: full sensor publish only once per interval (window mean)
+            cv.Optional(CONF_PUBLISH_INTERVAL): cv.positive_time_period_milliseconds,
+            # Every frame, bypassing filters and API fan-out
+            cv.Optional(CONF_ON_RAW_VALUE): automation.validate_automation(
+                {
+                    cv.GenerateID(CONF_TRIGGER_ID): cv.declare_id(RawDistanceTrigger),
+                }
+            ),
+        }
+    )
     .extend(cv.polling_component_schema("60s"))
     .extend(uart.UART_DEVICE_SCHEMA)
     .extend(cv.COMPONENT_SCHEMA)
@@ -146,4 +233,49 @@ async def to_code(config):
     await sensor.register_sensor(var, config)
     
     # Register UART device
-    await uart.register_uart_device(var, config)
\ No newline at end of file
+    await uart.register_uart_device(var, config)
+    
+    # Enable rollups, optionally aligned to a real time clock
+    if CONF_ROLLUPS in config:
+        rollups_config = config[CONF_ROLLUPS]
+        cg.add(var.enable_rollups())
+        if CONF_TIME_ID in rollups_config:
+            time_ = await cg.get_variable(rollups_config[CONF_TIME_ID])
+            cg.add(var.set_time(time_))
+    
+    # Enable time-to-collision estimation and its outputs
+    if CONF_TIME_TO_COLLISION in config:
+        ttc_config = config[CONF_TIME_TO_COLLISION]
+        cg.add(var.enable_ttc(ttc_config[CONF_SMOOTHING]))
+        if CONF_SENSOR in ttc_config:
+            ttc_sensor = await sensor.new_sensor(ttc_config[CONF_SENSOR])
+            cg.add(var.set_ttc_sensor(ttc_sensor))
+        if CONF_STOP_PIN in ttc_config:
+            stop_pin = await cg.gpio_pin_expression(ttc_config[CONF_STOP_PIN])
+            cg.add(var.set_stop_pin(stop_pin, ttc_config[CONF_STOP_BELOW]))
+            cg.add(var.set_stop_release_no_target_frames(ttc_config[CONF_RELEASE_AFTER_NO_TARGET]))
+        for conf in ttc_config.get(CONF_ON_BELOW, []):
+            trigger = cg.new_Pvariable(conf[CONF_TRIGGER_ID], var, conf[CONF_BELOW])
+            await automation.build_automation(trigger, [(float, "x")], conf)
+    
+    # Lean publish mode and per-frame raw value automations
+    if CONF_PUBLISH_INTERVAL in config:
+        cg.add(var.set_publish_interval(config[CONF_PUBLISH_INTERVAL]))
+    for conf in config.get(CONF_ON_RAW_VALUE, []):
+        trigger = cg.new_Pvariable(conf[CONF_TRIGGER_ID], var)
+        await automation.build_automation(trigger, [(float, "x")], conf)
+
+
+@automation.register_action(
+    "dts6012m_uart.release_stop",
+    ReleaseStopAction,
+    cv.Schema(
+        {
+            cv.GenerateID(): cv.use_id(DTS6012MUartSensor),
+        }
+    ),
+)
+async def release_stop_to_code(config, action_id, template_arg, args):
+    """Generate the action that releases a latched stop pin."""
+    parent = await cg.get_variable(config[CONF_ID])
+    return cg.new_Pvariable(action_id, template_arg, parent)